@@ -35,6 +35,10 @@ def AddData(directory, storage):
     Nsample = 0
     for i, sample in enumerate(samples):
         data = json.load(open(sample))
+        # METTS samples are not weighted by their norms like random phase states
+        if data.get('Method') == 'METTS':
+            raise RuntimeError('{} is produced by METTS. '
+                               'Use PlotJackknife.py instead'.format(sample))
         if i == 0:
             if 'beta' not in storage:
                 storage['beta'] = np.array(data['beta'])
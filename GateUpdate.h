@@ -0,0 +1,156 @@
+// Licensed under the MIT License <http://opensource.org/MIT>
+//
+// Copyright (c) 2021 Shimpei Goto
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+/// @file GateUpdate.h
+/// @brief Header file which contains functions to apply two-site gates to MPS with selectable decompositions
+/// @author Shimpei Goto
+
+#ifndef UUID_3D6A9F12_84C5_4B0E_9E27_51F0C8A3B6D4
+#define UUID_3D6A9F12_84C5_4B0E_9E27_51F0C8A3B6D4
+#include <itensor/all_mps.h>
+#include "RandomPhaseState.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace GateUpdate {
+        /// @brief Function to produce the index of the range approximated by randomized SVD
+        ///
+        /// Without QNs, the range has min(k, dim(cr)) dimensions.
+        /// With QNs, each QN block of cr gets min(k, size of the block) dimensions,
+        /// because power iterations cannot recover singular vectors outside the random subspace of each block.
+        ///
+        /// @param cr column index of the matrix to be decomposed
+        /// @param k number of random vectors
+        itensor::Index RangeIndex(const itensor::Index &cr, long k)
+        {
+                if (!itensor::hasQNs(cr)) {
+                        return itensor::Index(std::min(itensor::dim(cr), k), "Range");
+                }
+
+                std::vector<std::pair<itensor::QN, long>> qnstorage;
+                for (int b = 1; b <= itensor::nblock(cr); b++) {
+                        qnstorage.emplace_back(itensor::qn(cr, b), std::min(itensor::blocksize(cr, b), k));
+                }
+                return itensor::Index(std::move(qnstorage), itensor::dir(cr), "Range");
+        }
+
+        /// @brief Function to perform truncated SVD of a matrix by the randomized range finder
+        ///
+        /// The range of M is approximated by the random vectors of the index r refined by "PowerIterations" power iterations,
+        /// and the truncated SVD is performed in the approximated range.
+        /// The random vectors are drawn from the stream 1 of RandomPhaseState::Philox keyed by "Seed" and "Sample" of args
+        /// with the counter "Gate" of args, so that the result does not depend on the other samples.
+        ///
+        /// @param M ITensor with two indices cl and cr
+        /// @param cl row index of M
+        /// @param cr column index of M
+        /// @param r index of the range produced by GateUpdate::RangeIndex
+        /// @param U ITensor to store left singular vectors
+        /// @param S ITensor to store singular values
+        /// @param V ITensor to store right singular vectors
+        /// @param args itensor::Args used for truncation
+        itensor::Spectrum RandomizedSVD(const itensor::ITensor &M, const itensor::Index &cl, const itensor::Index &cr, const itensor::Index &r,
+                                        itensor::ITensor &U, itensor::ITensor &S, itensor::ITensor &V, const itensor::Args &args)
+        {
+                int n_power = args.getInt("PowerIterations", 2);
+
+                auto is = itensor::IndexSet(itensor::dag(cr), r);
+                itensor::ITensor Omega;
+                if (itensor::hasQNs(cr)) {
+                        Omega = itensor::ITensor(is, itensor::QDenseReal(is, itensor::QN()));
+                } else {
+                        Omega = itensor::ITensor(is, itensor::DenseReal(itensor::dim(is)));
+                }
+                RandomPhaseState::Philox rng(std::stoull(args.getString("Seed", "0")), args.getInt("Sample", 0), 1);
+                uint32_t gate = args.getInt("Gate", 0);
+                uint32_t element = 0;
+                // Gaussian random numbers by the Box-Muller transformation
+                Omega.generate([&rng, gate, &element]() {
+                        double rho = std::sqrt(-2.0*std::log(1.0 - rng(gate, element++)));
+                        double theta = 4.0*std::acos(0.0)*rng(gate, element++);
+                        return rho*std::cos(theta);
+                });
+
+                auto Y = M*Omega;
+                for (int i = 0; i < n_power; i++) {
+                        // Orthonormalization of the range before each power iteration for numerical stability
+                        auto [Q, s, W] = itensor::svd(Y, {cl});
+                        Y = M*(itensor::dag(M)*Q);
+                }
+                auto [Q, s, W] = itensor::svd(Y, {cl});
+                auto q = itensor::commonIndex(Q, s);
+
+                auto B = itensor::dag(Q)*M;
+                itensor::ITensor u(itensor::dag(q));
+                auto spec = itensor::svd(B, u, S, V, args);
+                U = Q*u;
+
+                return spec;
+        }
+
+        /// @brief Function to apply a two-site gate to MPS
+        ///
+        /// The orthogonality center of psi should be on site b and is moved to site b+1 after the application.
+        /// The decomposition of the updated two-site tensor is selected by the key "Decomposition" of args.
+        /// If it is "Randomized", GateUpdate::RandomizedSVD with MaxDim + "Oversampling" random vectors is used
+        /// unless the range reaches "FullRankRatio" (0.8 by default) of the full rank of the two-site tensor.
+        /// Otherwise, itensor::applyGate with the full SVD is used.
+        ///
+        /// @param b left site index of two sites to which the gate is applied
+        /// @param gate ITensor of the gate
+        /// @param psi MPS to be updated
+        /// @param args itensor::Args used for decomposition and truncation
+        void ApplyGate(int b, const itensor::ITensor &gate, itensor::MPS &psi, const itensor::Args &args)
+        {
+                if (args.getString("Decomposition", "Full") != "Randomized") {
+                        itensor::applyGate(gate, psi, args);
+                        return;
+                }
+
+                auto AA = psi(b)*psi(b+1)*gate;
+                AA.noPrime();
+                auto Cl = itensor::combiner(itensor::uniqueInds(psi(b), psi(b+1)));
+                auto Cr = itensor::combiner(itensor::uniqueInds(psi(b+1), psi(b)));
+                auto cl = itensor::combinedIndex(Cl);
+                auto cr = itensor::combinedIndex(Cr);
+
+                auto r = RangeIndex(cr, args.getInt("MaxDim") + args.getInt("Oversampling", 10));
+                double ratio = args.getReal("FullRankRatio", 0.8);
+                if (itensor::dim(r) >= ratio*std::min(itensor::dim(cl), itensor::dim(cr))) {
+                        psi.svdBond(b, AA, itensor::Fromleft, args);
+                        return;
+                }
+
+                itensor::ITensor U, S, V;
+                auto svd_args = args;
+                svd_args.add("LeftTags", itensor::format("Link,l=%d", b));
+                RandomizedSVD(AA*Cl*Cr, cl, cr, r, U, S, V, svd_args);
+                psi.ref(b) = U*itensor::dag(Cl);
+                psi.ref(b+1) = S*V*itensor::dag(Cr);
+                psi.leftLim(b);
+                psi.rightLim(b+2);
+        }
+} // namespace GateUpdate
+#endif //UUID_3D6A9F12_84C5_4B0E_9E27_51F0C8A3B6D4
@@ -0,0 +1,169 @@
+// Licensed under the MIT License <http://opensource.org/MIT>
+//
+// Copyright (c) 2021 Shimpei Goto
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+/// @file METTS.h
+/// @brief Header file which contains functions to produce minimally entangled typical thermal states (METTS)
+/// @author Shimpei Goto
+
+#ifndef UUID_8F0C2E61_3B7A_4D59_A1E4_6C2D9B5F7A30
+#define UUID_8F0C2E61_3B7A_4D59_A1E4_6C2D9B5F7A30
+#include <itensor/all_mps.h>
+#include "RandomPhaseState.h"
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace METTS {
+        /// @brief Function to produce a basis of local Hilbert space drawn from the Haar measure
+        ///
+        /// @param s site index
+        /// @param rng counter-based random number generator
+        /// @param site index of site used as the counter of rng
+        std::vector<itensor::ITensor> HaarBasis(const itensor::Index &s, const RandomPhaseState::Philox &rng, int site)
+        {
+                int d = itensor::dim(s);
+                std::vector<std::vector<std::complex<double>>> vecs;
+                vecs.reserve(d);
+                int element = 1;
+                for (int k = 0; k < d; k++) {
+                        // Gram-Schmidt orthonormalization of complex Gaussian vectors
+                        std::vector<std::complex<double>> vec(d);
+                        for (auto&& x : vec) {
+                                double r = std::sqrt(-2.0*std::log(1.0 - rng(site, element++)));
+                                double theta = 4.0*std::acos(0.0)*rng(site, element++);
+                                x = std::complex<double>(r*std::cos(theta), r*std::sin(theta));
+                        }
+                        for (auto&& prev : vecs) {
+                                std::complex<double> overlap = 0.0;
+                                for (int a = 0; a < d; a++) {
+                                        overlap += std::conj(prev[a])*vec[a];
+                                }
+                                for (int a = 0; a < d; a++) {
+                                        vec[a] -= overlap*prev[a];
+                                }
+                        }
+                        double nrm = 0.0;
+                        for (auto&& x : vec) {
+                                nrm += std::norm(x);
+                        }
+                        for (auto&& x : vec) {
+                                x /= std::sqrt(nrm);
+                        }
+                        vecs.push_back(vec);
+                }
+
+                std::vector<itensor::ITensor> basis;
+                basis.reserve(d);
+                for (auto&& vec : vecs) {
+                        auto v = itensor::ITensor(s);
+                        for (int a = 1; a <= d; a++) {
+                                v.set(s(a), vec[a-1]);
+                        }
+                        basis.push_back(v);
+                }
+
+                return basis;
+        }
+
+        /// @brief Function to collapse a state into a product state
+        ///
+        /// Each site is measured one by one according to the Born rule.
+        /// If sites have Abelian symmetries, the measurement is performed in the basis of the site index to keep the symmetry sector.
+        /// Otherwise, the basis is randomly drawn from the Haar measure for each site.
+        ///
+        /// @param psi MPS to be collapsed
+        /// @param rng counter-based random number generator
+        itensor::MPS CollapsedState(itensor::MPS psi, const RandomPhaseState::Philox &rng)
+        {
+                int N = itensor::length(psi);
+                psi.position(1);
+                psi.normalize();
+
+                std::vector<itensor::ITensor> states;
+                states.reserve(N);
+                auto cur = psi(1);
+                for (int n = 1; n <= N; n++) {
+                        auto s = itensor::siteIndex(psi, n);
+                        std::vector<itensor::ITensor> basis;
+                        if (itensor::hasQNs(s)) {
+                                for (int k = 1; k <= itensor::dim(s); k++) {
+                                        basis.push_back(itensor::setElt(s(k)));
+                                }
+                        } else {
+                                basis = HaarBasis(s, rng, n);
+                        }
+
+                        std::vector<itensor::ITensor> projected;
+                        std::vector<double> probs;
+                        double total = 0.0;
+                        for (auto&& v : basis) {
+                                projected.push_back(cur*itensor::dag(v));
+                                probs.push_back(std::pow(itensor::norm(projected.back()), 2));
+                                total += probs.back();
+                        }
+
+                        double r = total*rng(n, 0);
+                        size_t k = 0;
+                        while (k+1 < probs.size() and r >= probs[k]) {
+                                r -= probs[k];
+                                k++;
+                        }
+
+                        states.push_back(basis[k]);
+                        cur = projected[k] / std::sqrt(probs[k]);
+                        if (n < N) {
+                                cur *= psi(n+1);
+                        }
+                }
+
+                std::vector<itensor::Index> links(N+1);
+                if (itensor::hasQNs(itensor::siteIndex(psi, 1))) {
+                        std::vector<itensor::QN> qns(N+1);
+                        for (int n = 1; n <= N; n++) {
+                                qns[0] += itensor::flux(states[n-1]);
+                        }
+                        for (int n = 1; n <= N; n++) {
+                                qns[n] = qns[n-1] - itensor::flux(states[n-1]);
+                        }
+                        for (int l = 0; l <= N; l++) {
+                                auto ts = itensor::format("Link,l=%d", l);
+                                links[l] = itensor::Index(qns[l], 1, itensor::Out, ts);
+                        }
+                } else {
+                        for (int l = 0; l <= N; l++) {
+                                auto ts = itensor::format("Link,l=%d", l);
+                                links[l] = itensor::Index(1, ts);
+                        }
+                }
+
+                itensor::MPS res(N);
+                for (int n = 1; n <= N; n++) {
+                        res.ref(n) = states[n-1]*itensor::setElt(itensor::dag(links.at(n-1))(1))*itensor::setElt(links.at(n)(1));
+                }
+                res.ref(1) *= itensor::setElt(links.at(0)(1));
+                res.ref(N) *= itensor::setElt(itensor::dag(links.at(N))(1));
+
+                res.position(1);
+
+                return res;
+        }
+} // namespace METTS
+#endif //UUID_8F0C2E61_3B7A_4D59_A1E4_6C2D9B5F7A30
@@ -24,6 +24,7 @@ import numpy as np
 import matplotlib.pyplot as plt
 import toml
 import json
+import warnings
 from glob import glob
 
 
@@ -91,26 +92,56 @@ for i, sample in enumerate(samples):
     energies.append(data['LowestEnergy'])
 gene = min(energies)
 
+is_metts = False
 for i, sample in enumerate(samples):
     data = json.load(open(sample))
+    method = data.get('Method', 'RandomPhase')
+    norm_sq_file = []
+    ene_file = []
+    ene_sq_file = []
     for each in data['Samples']:
-        norm = (np.exp(0.5*beta*(gene - each['Energy'][-1]))
-                * np.array(each['Norm']))
+        if method == 'METTS':
+            # METTS samples are reweighted from the final inverse temperature
+            norm = (np.exp(0.5*(beta[-1] - beta)*(each['Energy'][-1] - gene))
+                    * np.array(each['Norm']) / each['Norm'][-1])
+        else:
+            norm = (np.exp(0.5*beta*(gene - each['Energy'][-1]))
+                    * np.array(each['Norm']))
         ene = np.array(each['Energy'])
         ene_sq = np.array(each['SquaredEnergy'])
-        norm_sq_arr.append(norm*norm)
-        ene_arr.append(norm*norm*ene)
-        ene_sq_arr.append(norm*norm*ene_sq)
+        norm_sq_file.append(norm*norm)
+        ene_file.append(norm*norm*ene)
+        ene_sq_file.append(norm*norm*ene_sq)
         M_arr.append(each['BondDim'])
+    if method == 'METTS':
+        # Consecutive samples of a Markov chain are correlated and binned
+        is_metts = True
+        bin_size = setting.get('METTS', {}).get('BinSize', 1)
+        nbin = len(norm_sq_file) // bin_size
+        if nbin*bin_size < len(norm_sq_file):
+            warnings.warn('{}: the last {} of {} samples do not fill a bin '
+                          'and are dropped'.format(
+                              sample, len(norm_sq_file) - nbin*bin_size,
+                              len(norm_sq_file)))
+        for arr, storage in [(norm_sq_file, norm_sq_arr), (ene_file, ene_arr),
+                             (ene_sq_file, ene_sq_arr)]:
+            for n in range(nbin):
+                storage.append(np.average(
+                    arr[n*bin_size:(n+1)*bin_size], axis=0))
+    else:
+        norm_sq_arr.extend(norm_sq_file)
+        ene_arr.extend(ene_file)
+        ene_sq_arr.extend(ene_sq_file)
+
+if len(norm_sq_arr) < 2:
+    raise RuntimeError('At least two samples (or bins of METTS samples) '
+                       'are needed for jackknife estimates')
 
 norm_sq_arr = np.array(norm_sq_arr).T
 ene_arr = np.array(ene_arr).T
 ene_sq_arr = np.array(ene_sq_arr).T
 M_arr = np.array(M_arr).T
 
-sampled_Z = np.average(norm_sq_arr, axis=1)
-sampled_Z_err = np.sqrt(np.var(norm_sq_arr, axis=1)/Nsample)
-
 ave, bias, err = jackknife_estimate([ene_arr, norm_sq_arr], Observable)
 sampled_ene = ave/N
 sampled_ene_err = err/N
@@ -119,44 +150,53 @@ ave, bias, err = jackknife_estimate([ene_sq_arr, ene_arr, norm_sq_arr],
 sampled_C = beta*beta*ave/N
 sampled_C_err = beta*beta*err/N
 
-ave, bias, err = jackknife_estimate([norm_sq_arr, ene_arr],
-                                    lambda x, y: Entropy(x, y, beta, gene))
-sampled_entropy = ave/N
-sampled_entropy_err = err/N
-
-ave, bias, err = jackknife_estimate([norm_sq_arr[1:, :]], FreeEnergy)
-sampled_free = (ave/beta[1:] + gene)/N
-sampled_free_err = (err/beta[1:])/N
-
-ave, bias, err = jackknife_estimate([norm_sq_arr, ene_arr],
-                                    lambda x, y:
-                                    EntropyDerivative(x, y, beta, gene))
-sampled_C_dS = -beta*ave/N
-sampled_C_dS_err = beta*err/N
-
 plt.subplot(3, 2, 1)
 plt.errorbar(beta, sampled_ene, yerr=sampled_ene_err)
 plt.ylabel(r'$\langle \hat{H} \rangle / L$')
 
-plt.subplot(3, 2, 2)
-plt.errorbar(beta, sampled_Z, yerr=sampled_Z_err)
-plt.axhline(y=1.0, linestyle='--', color='r')
-plt.ylabel(r'$\mathrm{e}^{\beta E_0} Z(\beta)$')
-plt.yscale('log')
-
-plt.subplot(3, 2, 3)
-plt.errorbar(beta[1:], sampled_free, yerr=sampled_free_err)
-plt.ylabel(r'$-\ln Z(\beta) / (\beta L)$')
+plt.subplot(3, 2, 5)
+plt.errorbar(beta, sampled_C, yerr=sampled_C_err, label='fluctuation')
 
-plt.subplot(3, 2, 4)
-plt.errorbar(beta, sampled_entropy, yerr=sampled_entropy_err)
-plt.axhline(y=0.0, linestyle='--', color='r')
-plt.ylabel(r'$S / (k_\mathrm{B} L)$')
+# The partition function is not available from METTS
+if not is_metts:
+    sampled_Z = np.average(norm_sq_arr, axis=1)
+    sampled_Z_err = np.sqrt(np.var(norm_sq_arr, axis=1)/Nsample)
+
+    ave, bias, err = jackknife_estimate([norm_sq_arr, ene_arr],
+                                        lambda x, y:
+                                        Entropy(x, y, beta, gene))
+    sampled_entropy = ave/N
+    sampled_entropy_err = err/N
+
+    ave, bias, err = jackknife_estimate([norm_sq_arr[1:, :]], FreeEnergy)
+    sampled_free = (ave/beta[1:] + gene)/N
+    sampled_free_err = (err/beta[1:])/N
+
+    ave, bias, err = jackknife_estimate([norm_sq_arr, ene_arr],
+                                        lambda x, y:
+                                        EntropyDerivative(x, y, beta, gene))
+    sampled_C_dS = -beta*ave/N
+    sampled_C_dS_err = beta*err/N
+
+    plt.errorbar(beta, sampled_C_dS, yerr=sampled_C_dS_err,
+                 label=r'$-\beta\frac{\partial S}{\partial \beta}$')
+
+    plt.subplot(3, 2, 2)
+    plt.errorbar(beta, sampled_Z, yerr=sampled_Z_err)
+    plt.axhline(y=1.0, linestyle='--', color='r')
+    plt.ylabel(r'$\mathrm{e}^{\beta E_0} Z(\beta)$')
+    plt.yscale('log')
+
+    plt.subplot(3, 2, 3)
+    plt.errorbar(beta[1:], sampled_free, yerr=sampled_free_err)
+    plt.ylabel(r'$-\ln Z(\beta) / (\beta L)$')
+
+    plt.subplot(3, 2, 4)
+    plt.errorbar(beta, sampled_entropy, yerr=sampled_entropy_err)
+    plt.axhline(y=0.0, linestyle='--', color='r')
+    plt.ylabel(r'$S / (k_\mathrm{B} L)$')
 
 plt.subplot(3, 2, 5)
-plt.errorbar(beta, sampled_C, yerr=sampled_C_err, label='fluctuation')
-plt.errorbar(beta, sampled_C_dS, yerr=sampled_C_dS_err,
-             label=r'$-\beta\frac{\partial S}{\partial \beta}$')
 plt.legend()
 plt.ylabel(r'$C / (k_\mathrm{B} L)$')
 
@@ -24,7 +24,13 @@
 #include "ZigZag_bond.h"
 #include "XXZ_bond.h"
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 #include <toml.hpp>
 #include <json.hpp>
 
@@ -32,15 +38,194 @@ namespace  {
         class Observer {
                 private:
                         itensor::MPO H_;
+                        // exp(i*theta_k*Sz) on each site with theta_k = 2*pi*k/(N+1) to resolve total Sz sectors
+                        std::vector<std::vector<itensor::ITensor>> rotations_;
 
                 public:
                         Observer(itensor::MPO &H) : H_(H) {};
+                        Observer(itensor::MPO &H, const itensor::SiteSet &sites);
                         void operator()(const itensor::MPS &psi, nlohmann::json &sample);
         };
 
+        Observer::Observer(itensor::MPO &H, const itensor::SiteSet &sites) : H_(H) {
+                int N = itensor::length(sites);
+                rotations_.reserve(N+1);
+                for (int k = 0; k <= N; k++) {
+                        double theta = 4.0*std::acos(0.0)*k/(N+1);
+                        std::vector<itensor::ITensor> rotation;
+                        rotation.reserve(N);
+                        for (int n = 1; n <= N; n++) {
+                                rotation.push_back(itensor::expHermitian(itensor::op(sites, "Sz", n), itensor::Cplx(0.0, theta)));
+                        }
+                        rotations_.push_back(rotation);
+                }
+        }
+
         void Observer::operator()(const itensor::MPS &psi, nlohmann::json &sample) {
                 sample["SquaredEnergy"].push_back(itensor::innerC(itensor::prime(psi, 2), itensor::prime(H_, 1), H_, psi).real());
                 sample["Energy"].push_back(itensor::innerC(psi, H_, psi).real());
+                if (rotations_.empty()) {
+                        return;
+                }
+
+                // Sz-resolved quantities are obtained by the Fourier transformation of <psi|O exp(i*theta_k*Sz)|psi>
+                int N = itensor::length(psi);
+                std::vector<std::complex<double>> gen(N+1), gen_ene(N+1), gen_ene_sq(N+1);
+                for (int k = 0; k <= N; k++) {
+                        auto rotated = psi;
+                        for (int n = 1; n <= N; n++) {
+                                rotated.ref(n) = itensor::noPrime(rotated(n)*rotations_[k][n-1]);
+                        }
+                        gen[k] = itensor::innerC(psi, rotated);
+                        gen_ene[k] = itensor::innerC(psi, H_, rotated);
+                        gen_ene_sq[k] = itensor::innerC(itensor::prime(psi, 2), itensor::prime(H_, 1), H_, rotated);
+                }
+
+                std::vector<double> dist(N+1), ene(N+1), ene_sq(N+1);
+                double sz = 0.0, sz_sq = 0.0;
+                for (int j = 0; j <= N; j++) {
+                        double m = j - 0.5*N;
+                        std::complex<double> p = 0.0, e = 0.0, e_sq = 0.0;
+                        for (int k = 0; k <= N; k++) {
+                                auto phase = std::exp(std::complex<double>(0.0, -4.0*std::acos(0.0)*k*m/(N+1)));
+                                p += gen[k]*phase;
+                                e += gen_ene[k]*phase;
+                                e_sq += gen_ene_sq[k]*phase;
+                        }
+                        dist[j] = p.real()/(N+1);
+                        ene[j] = e.real()/(N+1);
+                        ene_sq[j] = e_sq.real()/(N+1);
+                        sz += m*dist[j];
+                        sz_sq += m*m*dist[j];
+                }
+                sample["SzDistribution"].push_back(dist);
+                sample["EnergyBySz"].push_back(ene);
+                sample["SquaredEnergyBySz"].push_back(ene_sq);
+                sample["Sz"].push_back(sz);
+                sample["SquaredSz"].push_back(sz_sq);
+        }
+
+        using Gates = std::vector<std::pair<int, itensor::ITensor>>;
+
+        // Coefficients of symmetric second-order steps composing a single step
+        std::vector<double> TrotterCoefficients(const std::string &scheme) {
+                if (scheme == "Second") {
+                        return {1.0};
+                }
+                if (scheme == "ForestRuth") {
+                        double theta = 1.0 / (2.0 - std::cbrt(2.0));
+                        return {theta, 1.0 - 2.0*theta, theta};
+                }
+                if (scheme == "Suzuki") {
+                        double p = 1.0 / (4.0 - std::cbrt(4.0));
+                        return {p, p, 1.0 - 4.0*p, p, p};
+                }
+                throw std::runtime_error("TrotterScheme should be Second, ForestRuth, or Suzuki");
+        }
+
+        enum class Layer { Odd, Even, NextNearest, NextNearestReversed };
+
+        // Gates exp(tau*h) on a layer of bonds
+        Gates LayerGates(ZigZag_Trotter::ZigZag_Bond &sys, int Ns, Layer layer, double tau) {
+                Gates gates;
+                if (layer == Layer::Odd or layer == Layer::Even) {
+                        for (int i = (layer == Layer::Odd ? 1 : 2); i <= Ns-1; i+=2) {
+                                gates.emplace_back(i, sys.BondTerm(i, i+1, tau, i));
+                        }
+                } else {
+                        for (int i = 1; i <= Ns-2; i++) {
+                                gates.emplace_back(i+1, sys.Swap(i+1));
+                                gates.emplace_back(i, sys.BondTerm(i, i+2, tau, i));
+                                gates.emplace_back(i+1, sys.Swap(i+1));
+                        }
+                        if (layer == Layer::NextNearestReversed) {
+                                std::reverse(gates.begin(), gates.end());
+                        }
+                }
+
+                return gates;
+        }
+
+        // Gates for a single step exp(-0.5*dBeta*H) composed of symmetric second-order steps
+        // Higher-order schemes include steps with negative imaginary time
+        // Adjacent layers of nearest neighbor bonds commute within themselves and are merged into a single layer
+        Gates TrotterStep(ZigZag_Trotter::ZigZag_Bond &sys, int Ns, double J2, double dBeta, const std::string &scheme) {
+                std::vector<std::pair<Layer, double>> layers;
+                auto push = [&layers](Layer layer, double tau) {
+                        bool nearest = (layer == Layer::Odd or layer == Layer::Even);
+                        if (nearest and !layers.empty() and layers.back().first == layer) {
+                                layers.back().second += tau;
+                        } else {
+                                layers.emplace_back(layer, tau);
+                        }
+                };
+                for (auto&& c : TrotterCoefficients(scheme)) {
+                        double tau = -0.25*c*dBeta;
+                        push(Layer::Odd, tau);
+                        push(Layer::Even, tau);
+                        if (std::abs(J2) >= 1e-8) {
+                                push(Layer::NextNearest, tau);
+                                push(Layer::NextNearestReversed, tau);
+                        }
+                        push(Layer::Even, tau);
+                        push(Layer::Odd, tau);
+                }
+
+                Gates gates;
+                for (auto&& x : layers) {
+                        auto layer_gates = LayerGates(sys, Ns, x.first, x.second);
+                        gates.insert(gates.end(), layer_gates.begin(), layer_gates.end());
+                }
+
+                return gates;
+        }
+
+        void Evolve(const Gates &gates, itensor::MPS &psi, const itensor::Args &args) {
+                for (auto&& x : gates) {
+                        psi.position(x.first);
+                        GateUpdate::ApplyGate(x.first, x.second, psi, args);
+                        psi.normalize();
+                }
+        }
+
+        // Distance between states evolved by a single step of dBeta and two steps of dBeta/2
+        double TrotterError(ZigZag_Trotter::ZigZag_Bond &sys, int Ns, double J2, double dBeta, const std::string &scheme,
+                            const itensor::MPS &psi, const itensor::Args &args) {
+                auto psi_full = psi;
+                auto psi_half = psi;
+                Evolve(TrotterStep(sys, Ns, J2, dBeta, scheme), psi_full, args);
+                auto half_step = TrotterStep(sys, Ns, J2, 0.5*dBeta, scheme);
+                Evolve(half_step, psi_half, args);
+                Evolve(half_step, psi_half, args);
+
+                return std::sqrt(std::abs(2.0 - 2.0*itensor::innerC(psi_full, psi_half).real()));
+        }
+
+        // Comparison of states evolved by NBeta steps with full SVD and randomized SVD
+        // The counter of random vectors in randomized SVD is advanced for each gate in the same way as randomMPS::Sampler
+        void DecompositionCheck(const Gates &gates, int NBeta, itensor::MPO &H, const itensor::MPS &psi, const itensor::Args &args) {
+                std::vector<itensor::MPS> evolved;
+                for (auto&& decomposition : {"Full", "Randomized"}) {
+                        auto psi_evolved = psi;
+                        auto args_evolved = args;
+                        args_evolved.add("Decomposition", decomposition);
+                        long gate = 0;
+                        auto start = std::chrono::system_clock::now();
+                        for (int i = 0; i < NBeta; i++) {
+                                for (auto&& x : gates) {
+                                        psi_evolved.position(x.first);
+                                        args_evolved.add("Gate", gate++);
+                                        GateUpdate::ApplyGate(x.first, x.second, psi_evolved, args_evolved);
+                                        psi_evolved.normalize();
+                                }
+                        }
+                        auto end = std::chrono::system_clock::now();
+                        double elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+                        std::cout << "Decomposition check (" << decomposition << "), Energy:" << itensor::innerC(psi_evolved, H, psi_evolved).real()
+                                  << ", BondDim:" << itensor::maxLinkDim(psi_evolved) << ", Elapsed time:" << elapsed / 1000 << "s" << std::endl;
+                        evolved.push_back(psi_evolved);
+                }
+                std::cout << "Decomposition check, Distance:" << std::sqrt(std::abs(2.0 - 2.0*itensor::innerC(evolved[0], evolved[1]).real())) << std::endl;
         }
 } // namespace
 
@@ -52,13 +237,39 @@ int main() {
         bool is_abelian = toml::find<bool>(toml, "System", "AbelianSymmetry");
         double hz = 0.0;
         int Sz = 0;
+        bool reweighting = false;
         if (!is_abelian) {
                 hz = toml::find<double>(toml, "System", "MagneticField");
+                if (toml.at("System").contains("FieldReweighting")) {
+                        reweighting = toml::find<bool>(toml, "System", "FieldReweighting");
+                }
         } else {
                 Sz = toml::find<int>(toml, "System", "2Sz");
         }
 
         double dBeta = toml::find<double>(toml, "tDMRG", "dBeta");
+        std::string method = "Trotter";
+        if (toml.at("tDMRG").contains("Method")) {
+                method = toml::find<std::string>(toml, "tDMRG", "Method");
+        }
+        if (method != "Trotter" and method != "MPO") {
+                throw std::runtime_error("Method should be Trotter or MPO");
+        }
+        std::string scheme = "Second";
+        if (toml.at("tDMRG").contains("TrotterScheme")) {
+                scheme = toml::find<std::string>(toml, "tDMRG", "TrotterScheme");
+        }
+        bool check_trotter = false;
+        if (toml.at("tDMRG").contains("TrotterErrorCheck")) {
+                check_trotter = toml::find<bool>(toml, "tDMRG", "TrotterErrorCheck");
+        }
+        bool check_decomposition = false;
+        if (toml.at("MPS").contains("DecompositionCheck")) {
+                check_decomposition = toml::find<bool>(toml, "MPS", "DecompositionCheck");
+        }
+        if (method == "MPO" and (scheme != "Second" or check_trotter or check_decomposition)) {
+                throw std::runtime_error("TrotterScheme, TrotterErrorCheck, and DecompositionCheck cannot be used with Method = MPO");
+        }
 
         int NSample = toml::find<int>(toml, "Sampling", "Sample");
 
@@ -84,7 +295,7 @@ int main() {
         }
 
         auto H = itensor::toMPO(ampo_H);
-        auto obs = Observer(H);
+        auto obs = reweighting ? Observer(H, sites) : Observer(H);
         randomMPS::Sampler Sampler(sites);
 
         if (is_abelian) {
@@ -97,34 +308,48 @@ int main() {
                 Sampler.set_target(target);
         }
 
-        // Setup Trotter gates
-        ZigZag_Trotter::ZigZag_Bond sys(Ns, J, J2, hz, sites);
-        std::vector<std::pair<int, itensor::ITensor>> gates;
-        int n_gates = 2*(Ns-1);
-        if (std::abs(J2) >= 1e-8) {
-                n_gates += 2*3*(Ns-2);
-        }
-        gates.reserve(n_gates);
-        for (int i = 1; i <= Ns-1; i+=2) {
-                gates.emplace_back(i, sys.BondTerm(i, i+1, -0.25*dBeta, i));
-        }
-        for (int i = 2; i <= Ns-1; i+=2) {
-                gates.emplace_back(i, sys.BondTerm(i, i+1, -0.25*dBeta, i));
-        }
+        // Setup MPOs for imaginary-time evolution
+        // The pair of complex time steps makes the error of exp(-0.5*dBeta*H) third order in dBeta
+        if (method == "MPO") {
+                auto expH1 = itensor::toExpH(ampo_H, itensor::Cplx(0.25*dBeta, -0.25*dBeta));
+                auto expH2 = itensor::toExpH(ampo_H, itensor::Cplx(0.25*dBeta, 0.25*dBeta));
+                Sampler.set_mpo({expH1, expH2});
+        } else {
+                // Setup Trotter gates
+                ZigZag_Trotter::ZigZag_Bond sys(Ns, J, J2, hz, sites);
+                Sampler.set_gates(TrotterStep(sys, Ns, J2, dBeta, scheme));
 
-        if (std::abs(J2) >= 1e-8) {
-                for (int i = 1; i <= Ns-2; i++) {
-                        gates.emplace_back(i+1, sys.Swap(i+1));
-                        gates.emplace_back(i, sys.BondTerm(i, i+2, -0.25*dBeta, i));
-                        gates.emplace_back(i+1, sys.Swap(i+1));
+                itensor::Args args(
+                                "MaxDim", toml::find<int>(toml, "MPS", "MaxM"),
+                                "Cutoff", toml::find<double>(toml, "MPS", "tol")
+                                );
+                itensor::MPS psi;
+                if (is_abelian) {
+                        psi = RandomPhaseState::RandomPhaseState(sites, itensor::QN({"Sz", Sz}), RandomPhaseState::Philox(0, 0));
+                } else {
+                        psi = RandomPhaseState::RandomPhaseState(sites, RandomPhaseState::Philox(0, 0));
+                        psi.normalize();
+                }
+
+                if (check_trotter) {
+                        for (auto&& x : {"Second", "ForestRuth", "Suzuki"}) {
+                                std::cout << "Trotter error per step (" << x << "):" << TrotterError(sys, Ns, J2, dBeta, x, psi, args)
+                                          << ", Gates per step:" << TrotterStep(sys, Ns, J2, dBeta, x).size() << std::endl;
+                        }
+                }
+
+                if (check_decomposition) {
+                        for (auto&& x : {"Oversampling", "PowerIterations"}) {
+                                if (toml.at("MPS").contains(x)) {
+                                        args.add(x, toml::find<int>(toml, "MPS", x));
+                                }
+                        }
+                        if (toml.at("MPS").contains("FullRankRatio")) {
+                                args.add("FullRankRatio", toml::find<double>(toml, "MPS", "FullRankRatio"));
+                        }
+                        DecompositionCheck(TrotterStep(sys, Ns, J2, dBeta, scheme), toml::find<int>(toml, "tDMRG", "NBeta"), H, psi, args);
                 }
         }
-        auto reversed = gates;
-        std::reverse(reversed.begin(), reversed.end());
-        for (auto&& x : reversed) {
-                gates.push_back(x);
-        }
-        Sampler.set_gates(gates);
 
         if (toml.contains("UnitaryTransformation")){
                 double tau_uni = toml::find<double>(toml, "UnitaryTransformation", "tau");
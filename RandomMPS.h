@@ -28,10 +28,17 @@
 
 #include <itensor/all_mps.h>
 #include "RandomPhaseState.h"
+#include "METTS.h"
+#include "GateUpdate.h"
 #include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
 #include <string>
 #include <random>
+#include <stdexcept>
 #include <toml.hpp>
 #include <utility>
 #include <json.hpp>
@@ -45,23 +52,34 @@ namespace randomMPS {
                 private:
                         uint_fast64_t seed_;
                         double dBeta_;
-                        int NBeta_, ObserveInterval_, n_uni_, count_;
+                        int NBeta_, ObserveInterval_, n_uni_, count_, n_resume_, n_warmup_, n_sample_;
+                        bool save_checkpoint_, metts_;
+                        uint64_t metts_step_;
+                        itensor::MPS metts_state_;
                         nlohmann::json output_;
-                        std::mt19937_64 engine_;
                         itensor::Args tevol_args_;
                         std::vector<double> beta_;
                         std::string filename_;
                         std::vector<std::vector<itensor::QN>> PossibleQNs_;
                         itensor::SiteSet sites_;
                         std::vector<std::pair<int, itensor::ITensor>> gates_, uni_gates_;
+                        std::vector<itensor::MPO> expH_;
+                        std::string telemetry_file_;
+                        double telemetry_interval_;
+                        long n_gates_, n_gates_reported_;
+                        std::chrono::system_clock::time_point start_, reported_;
 
                         void initialize();
+                        void resume(const std::string &resume_file);
+                        void report(const itensor::MPS &psi, double beta, double progress, bool force = false);
+                        template <typename T>
+                        void produce(T& observer, bool record);
 
                 public:
                         /// @brief Construnctor with random seed
                         ///
                         /// @param sites itensor::SiteSet instance used for MPS instance
-                        /// @param seed random seed for std::mt19937_64 generator
+                        /// @param seed random seed for the counter-based generator RandomPhaseState::Philox
                         Sampler(const itensor::SiteSet &sites, uint_fast64_t seed);
                         /// @brief Construnctor without random seed
                         ///
@@ -88,6 +106,14 @@ namespace randomMPS {
                         ///
                         /// @param gates Container of pair of index for left site to be applied and ITensor of Trotter gates.
                         void set_gates(const std::vector<std::pair<int, itensor::ITensor>> &gates) { gates_ = gates; }
+                        /// @brief Method to set MPOs used for imaginary-time evolution instead of Trotter gates
+                        ///
+                        /// MPOs are applied in order by itensor::applyMPO to evolve states by a single slice of imaginary time.
+                        /// The product of the MPOs should approximate exp(-0.5*dBeta*H), e.g. produced by itensor::toExpH.
+                        /// If this method is called, Trotter gates set by .set_gates(gates) are not used.
+                        ///
+                        /// @param mpos Container of MPOs applied in order.
+                        void set_mpo(const std::vector<itensor::MPO> &mpos) { expH_ = mpos; }
                         /// @brief Method to set Trotter gates used for unitary evolution of initial states
                         ///
                         /// Trotter gates are specified as a std::vector of std::pair<int, itensor::ITensor>.
@@ -103,6 +129,16 @@ namespace randomMPS {
                         /// Besides automatically sampled quantities "Energy", "BondDim", and "Norm", one can sample any quantities on demand
                         /// by passing MPS and json instances to user defined type observer.
                         ///
+                        /// If the key "Resume" in the section "Checkpoint" of setting.toml is specified,
+                        /// the samples stored in the file are extended to the present "NBeta" one by one before new samples are produced.
+                        ///
+                        /// If the key "Enabled" in the section "METTS" of setting.toml is true, the initial state of each sample is
+                        /// the product state obtained by collapsing the final state of the previous sample (METTS).
+                        /// In this case, the first "Warmup" samples of the Markov chain are discarded.
+                        ///
+                        /// If the section "Telemetry" of setting.toml is specified, the progress of the run is written to "File"
+                        /// in the Prometheus text format every "Interval" seconds.
+                        ///
                         /// @param observer An instance in which operator()(const itensor::MPS&, nlohmann::json&) is defined.
                         template <typename T>
                         void run(T& observer);
@@ -122,8 +158,6 @@ namespace randomMPS {
         }
 
         void Sampler::initialize() {
-                engine_.seed(seed_);
-
                 const auto toml = toml::parse("setting.toml");
                 dBeta_ = toml::find<double>(toml, "tDMRG", "dBeta");
                 NBeta_ = toml::find<int>(toml, "tDMRG", "NBeta");
@@ -135,6 +169,34 @@ namespace randomMPS {
                         n_uni_ = 0;
                 }
 
+                metts_ = false;
+                n_warmup_ = 0;
+                if (toml.contains("METTS")) {
+                        metts_ = toml::find<bool>(toml, "METTS", "Enabled");
+                        n_warmup_ = toml::find<int>(toml, "METTS", "Warmup");
+                }
+                metts_step_ = 0;
+
+                n_sample_ = toml::find<int>(toml, "Sampling", "Sample");
+                if (toml.contains("Telemetry")) {
+                        telemetry_file_ = toml::find<std::string>(toml, "Telemetry", "File");
+                        telemetry_interval_ = toml::find<double>(toml, "Telemetry", "Interval");
+                }
+                n_gates_ = 0;
+                n_gates_reported_ = 0;
+                start_ = std::chrono::system_clock::now();
+                reported_ = start_;
+
+                save_checkpoint_ = false;
+                std::string resume_file;
+                if (toml.contains("Checkpoint")) {
+                        const auto &checkpoint = toml::find(toml, "Checkpoint");
+                        save_checkpoint_ = toml::find<bool>(checkpoint, "Save");
+                        if (checkpoint.contains("Resume")) {
+                                resume_file = toml::find<std::string>(checkpoint, "Resume");
+                        }
+                }
+
                 int MaxM = toml::find<int>(toml, "MPS", "MaxM");
                 double tol = toml::find<double>(toml, "MPS", "tol");
 
@@ -142,8 +204,54 @@ namespace randomMPS {
                                 "MaxDim", MaxM,
                                 "Cutoff", tol
                                 );
+                if (toml.at("MPS").contains("Decomposition")) {
+                        std::string decomposition = toml::find<std::string>(toml, "MPS", "Decomposition");
+                        if (decomposition != "Full" and decomposition != "Randomized") {
+                                throw std::runtime_error("Decomposition should be Full or Randomized");
+                        }
+                        tevol_args_.add("Decomposition", decomposition);
+                }
+                // Parameters of randomized SVD are optional and default to those in GateUpdate::ApplyGate
+                if (tevol_args_.getString("Decomposition", "Full") == "Randomized") {
+                        if (toml.at("MPS").contains("Oversampling")) {
+                                tevol_args_.add("Oversampling", toml::find<int>(toml, "MPS", "Oversampling"));
+                        }
+                        if (toml.at("MPS").contains("PowerIterations")) {
+                                tevol_args_.add("PowerIterations", toml::find<int>(toml, "MPS", "PowerIterations"));
+                        }
+                        if (toml.at("MPS").contains("FullRankRatio")) {
+                                tevol_args_.add("FullRankRatio", toml::find<double>(toml, "MPS", "FullRankRatio"));
+                        }
+                }
 
-                output_["seed"] = seed_;
+                n_resume_ = 0;
+                if (!resume_file.empty()) {
+                        if (metts_) {
+                                throw std::runtime_error("Samples produced by METTS cannot be extended to lower temperatures");
+                        }
+                        std::ifstream in_file(resume_file);
+                        if (!in_file) {
+                                throw std::runtime_error("Cannot open " + resume_file + " to be resumed");
+                        }
+                        output_ = nlohmann::json::parse(in_file);
+                        resume(resume_file);
+                        if (n_sample_ < n_resume_) {
+                                throw std::runtime_error("Sample should be at least the number of samples stored in " + resume_file);
+                        }
+                } else {
+                        output_["seed"] = seed_;
+                        output_["LowestEnergy"] = nullptr;
+
+                        std::string file_pre("sample_"), file_suf(".json"), seed_str;
+                        seed_str = std::to_string(seed_);
+                        filename_ = file_pre + seed_str + file_suf;
+                }
+                // Random vectors of randomized SVD are drawn from the counter-based generator keyed by the seed
+                tevol_args_.add("Seed", std::to_string(seed_));
+                output_["Method"] = metts_ ? "METTS" : "RandomPhase";
+                output_["dBeta"] = dBeta_;
+                output_["NBeta"] = NBeta_;
+                output_["ObserveInterval"] = ObserveInterval_;
 
                 beta_.reserve(NBeta_ / ObserveInterval_ + 1);
                 for (int i = 0; i < NBeta_; i++) {
@@ -154,40 +262,165 @@ namespace randomMPS {
                 beta_.push_back(NBeta_*dBeta_);
                 output_["beta"] = beta_;
 
-                output_["LowestEnergy"] = nullptr;
+                count_ = 0;
+        }
 
-                std::string file_pre("sample_"), file_suf(".json"), seed_str;
-                seed_str = std::to_string(seed_);
-                filename_ = file_pre + seed_str + file_suf;
+        void Sampler::resume(const std::string &resume_file) {
+                if (std::abs(static_cast<double>(output_["dBeta"]) - dBeta_) > 1e-12 or output_["ObserveInterval"] != ObserveInterval_) {
+                        throw std::runtime_error("dBeta and ObserveInterval should be the same as those used in " + resume_file);
+                }
+                // Samples of an interrupted resumed run may already reach the present NBeta, and they are skipped in produce
+                for (auto&& sample : output_["Samples"]) {
+                        if (!sample.contains("Checkpoint")) {
+                                throw std::runtime_error(resume_file + " was produced without checkpoints");
+                        }
+                        int NBeta_stored = sample["Checkpoint"]["NBeta"];
+                        if (NBeta_stored > NBeta_) {
+                                throw std::runtime_error("NBeta should not be smaller than that of samples stored in " + resume_file);
+                        }
+                        if (NBeta_stored % ObserveInterval_ != 0) {
+                                throw std::runtime_error("Samples can be extended only when their NBeta is a multiple of ObserveInterval");
+                        }
+                }
 
-                count_ = 0;
+                // New samples are appended to the resumed file with subsequent sample indices
+                save_checkpoint_ = true;
+                filename_ = resume_file;
+                seed_ = output_["seed"];
+                n_resume_ = output_["Samples"].size();
+        }
+
+        void Sampler::report(const itensor::MPS &psi, double beta, double progress, bool force) {
+                if (telemetry_file_.empty()) {
+                        return;
+                }
+                auto now = std::chrono::system_clock::now();
+                double interval = std::chrono::duration<double>(now - reported_).count();
+                if (interval < telemetry_interval_ and !force) {
+                        return;
+                }
+                double elapsed = std::chrono::duration<double>(now - start_).count();
+                double done = count_ + progress;
+                double eta = done > 0.0 ? elapsed*(n_sample_ - done)/done : -1.0;
+
+                std::string label = "{seed=\"" + std::to_string(seed_) + "\"} ";
+                std::ofstream out_file(telemetry_file_ + ".tmp");
+                out_file << std::setprecision(std::numeric_limits<double>::max_digits10);
+                auto metric = [&out_file, &label](const std::string &name, const std::string &help, double value) {
+                        out_file << "# HELP " << name << " " << help << "\n";
+                        out_file << "# TYPE " << name << " gauge\n";
+                        out_file << name << label << value << "\n";
+                };
+                metric("rpmps_beta", "Inverse temperature of the sample in progress.", beta);
+                metric("rpmps_max_bond_dimension", "Maximum bond dimension of the sample in progress.", itensor::maxLinkDim(psi));
+                metric("rpmps_bond_dimension_limit", "Upper limit of bond dimensions.", tevol_args_.getInt("MaxDim"));
+                double rate = interval > 0.0 ? (n_gates_ - n_gates_reported_)/interval : 0.0;
+                if (expH_.empty()) {
+                        metric("rpmps_gates_per_second", "Gates applied per second since the last update.", rate);
+                } else {
+                        metric("rpmps_mpo_applications_per_second", "MPO applications per second since the last update.", rate);
+                }
+                metric("rpmps_samples_completed", "Number of completed samples.", count_);
+                metric("rpmps_samples_total", "Number of samples to be produced.", n_sample_);
+                metric("rpmps_samples_per_hour", "Completed samples per hour.", 3600.0*count_/elapsed);
+                metric("rpmps_eta_seconds", "Projected time to completion in seconds.", eta);
+                metric("rpmps_last_update_timestamp_seconds", "Unix time of the last update.",
+                       std::chrono::duration<double>(now.time_since_epoch()).count());
+                out_file.close();
+                // Renaming prevents collectors from reading partially written files
+                std::rename((telemetry_file_ + ".tmp").c_str(), telemetry_file_.c_str());
+
+                n_gates_reported_ = n_gates_;
+                reported_ = now;
         }
 
         template<typename T>
         void Sampler::run(T& observer) {
+                for (; n_warmup_ > 0 and metts_; n_warmup_--) {
+                        produce(observer, false);
+                }
+                produce(observer, true);
+        }
+
+        template<typename T>
+        void Sampler::produce(T& observer, bool record) {
 
                         nlohmann::json sample;
                         auto start = std::chrono::system_clock::now();
                         itensor::MPS psi;
-                        if (PossibleQNs_.size() > 0) {
-                                psi = RandomPhaseState::RandomPhaseState(sites_, PossibleQNs_, engine_);
+                        double nrm, ene_for_norm, norm_factor;
+                        int i_start;
+                        long gate = 0;
+                        bool is_resumed = count_ < n_resume_;
+                        size_t sample_idx = is_resumed ? count_ : output_["Samples"].size();
+                        // Checkpoint files are placed next to the output file and recorded without directories
+                        std::string dir = filename_.substr(0, filename_.rfind('/') + 1);
+                        // NBeta in the file names keeps the checkpoint referred by the output file intact until the output file is updated
+                        std::string mps_file = filename_.substr(dir.size(), filename_.rfind(".json") - dir.size()) + "_" + std::to_string(sample_idx)
+                                               + "_" + std::to_string(NBeta_) + ".mps";
+                        std::string stored_file;
+                        // Random vectors of randomized SVD depend only on the sample and the number of gates applied to it
+                        tevol_args_.add("Sample", static_cast<long>(metts_ ? metts_step_ : sample_idx));
+
+                        if (is_resumed) {
+                                sample = output_["Samples"].at(sample_idx);
+                                const auto checkpoint = sample["Checkpoint"];
+                                if (checkpoint["NBeta"] == NBeta_) {
+                                        count_++;
+                                        std::cout << "Sample " << count_ << " already reaches NBeta" << std::endl;
+                                        return;
+                                }
+                                stored_file = checkpoint["File"];
+                                stored_file = stored_file.substr(stored_file.rfind('/') + 1);
+                                psi = itensor::readFromFile<itensor::MPS>(dir + stored_file);
+                                // Site indices are regenerated in every run
+                                for (int n = 1; n <= itensor::length(psi); n++) {
+                                        psi.ref(n).replaceInds({itensor::siteIndex(psi, n)}, {sites_(n)});
+                                }
+
+                                // Stored norms are rescaled by the last energy at the end of the previous run
+                                i_start = checkpoint["NBeta"];
+                                nrm = checkpoint["nrm"];
+                                norm_factor = checkpoint["NormFactor"];
+                                ene_for_norm = checkpoint["EnergyForNorm"];
+                                gate = checkpoint.value("GateCount", 0L);
+                                double ene_last = sample["Energy"].back();
+                                double ene_diff = ene_last - ene_for_norm;
+                                nrm *= std::exp(i_start*0.5*dBeta_*ene_diff);
+                                norm_factor *= std::exp(0.5*dBeta_*ene_diff);
+                                ene_for_norm = ene_last;
+                        } else if (metts_ and metts_step_ > 0) {
+                                psi = metts_state_;
+                                nrm = psi.normalize();
+                                ene_for_norm = 0.0;
+                                norm_factor = 1.0;
+                                i_start = 0;
                         } else {
-                                psi = RandomPhaseState::RandomPhaseState(sites_, engine_);
-                        }
+                                // In METTS, only the first state of the Markov chain is a random phase state
+                                RandomPhaseState::Philox rng(seed_, metts_ ? 0 : sample_idx);
+                                if (PossibleQNs_.size() > 0) {
+                                        psi = RandomPhaseState::RandomPhaseState(sites_, PossibleQNs_, rng);
+                                } else {
+                                        psi = RandomPhaseState::RandomPhaseState(sites_, rng);
+                                }
 
-                        double nrm = psi.normalize();
-                        for (int i = 0; i < n_uni_; i++) {
-                                for (auto&& x : uni_gates_) {
-                                        psi.position(x.first);
-                                        itensor::applyGate(x.second, psi, tevol_args_);
-                                        nrm *= psi.normalize();
+                                nrm = psi.normalize();
+                                for (int i = 0; i < n_uni_; i++) {
+                                        for (auto&& x : uni_gates_) {
+                                                psi.position(x.first);
+                                                tevol_args_.add("Gate", gate++);
+                                                GateUpdate::ApplyGate(x.first, x.second, psi, tevol_args_);
+                                                nrm *= psi.normalize();
+                                        }
                                 }
+                                ene_for_norm = 0.0;
+                                norm_factor = 1.0;
+                                i_start = 0;
                         }
-                        double ene_for_norm = 0.0;
-                        double norm_factor = 1.0;
 
-                        for (int i = 0; i < NBeta_; i++) {
-                                if (i % ObserveInterval_ == 0) {
+                        for (int i = i_start; i < NBeta_; i++) {
+                                // The starting point of resumed samples has been observed in the previous run
+                                if (i % ObserveInterval_ == 0 and (i > i_start or !is_resumed)) {
                                         observer(psi, sample);
                                         sample["Norm"].push_back(nrm);
                                         sample["BondDim"].push_back(itensor::maxLinkDim(psi));
@@ -205,12 +438,22 @@ namespace randomMPS {
                                         }
                                 }
 
-                                for (auto&& x : gates_) {
-                                        psi.position(x.first);
-                                        itensor::applyGate(x.second, psi, tevol_args_);
-                                        nrm *= psi.normalize();
+                                if (expH_.empty()) {
+                                        for (auto&& x : gates_) {
+                                                psi.position(x.first);
+                                                tevol_args_.add("Gate", gate++);
+                                                GateUpdate::ApplyGate(x.first, x.second, psi, tevol_args_);
+                                                nrm *= psi.normalize();
+                                        }
+                                } else {
+                                        for (auto&& W : expH_) {
+                                                psi = itensor::applyMPO(W, psi, tevol_args_);
+                                                nrm *= psi.normalize();
+                                        }
                                 }
                                 nrm *= norm_factor;
+                                n_gates_ += expH_.empty() ? gates_.size() : expH_.size();
+                                report(psi, (i+1)*dBeta_, static_cast<double>(i+1-i_start)/(NBeta_-i_start));
 
                         }
                         observer(psi, sample);
@@ -223,18 +466,52 @@ namespace randomMPS {
                                 sample["Norm"].at(j) = val*std::exp(0.5*static_cast<double>(output_["beta"].at(j))*ene_diff);
                         }
 
-                        if (output_["LowestEnergy"].is_null() or output_["LowestEnergy"] > ene_present) {
-                                output_["LowestEnergy"] = ene_present;
+                        if (metts_) {
+                                metts_step_++;
+                                metts_state_ = METTS::CollapsedState(psi, RandomPhaseState::Philox(seed_, metts_step_));
                         }
 
-                        output_["Samples"].push_back(sample);
                         auto end = std::chrono::system_clock::now();
                         double elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+                        if (!record) {
+                                std::cout << "Warmup, Elapsed time:" << elapsed / 1000 << "s" << std::endl;
+                                return;
+                        }
+
+                        if (save_checkpoint_) {
+                                itensor::writeToFile(dir + mps_file, psi);
+                                sample["Checkpoint"] = {
+                                        {"File", mps_file},
+                                        {"NBeta", NBeta_},
+                                        {"nrm", nrm},
+                                        {"NormFactor", norm_factor},
+                                        {"EnergyForNorm", ene_for_norm},
+                                        {"GateCount", gate}
+                                };
+                        }
+
+                        if (output_["LowestEnergy"].is_null() or output_["LowestEnergy"] > ene_present) {
+                                output_["LowestEnergy"] = ene_present;
+                        }
+
                         count_++;
+                        report(psi, NBeta_*dBeta_, 0.0, true);
                         std::cout << "Sample " << count_ << ", Elapsed time:" << elapsed / 1000 << "s, Norm:" << sample["Norm"].back() << std::endl;
-                        output_["ElapsedTime"].push_back(elapsed/1000);
-                        std::ofstream out_file(filename_);
+                        if (is_resumed) {
+                                output_["Samples"].at(sample_idx) = sample;
+                                double elapsed_stored = output_["ElapsedTime"].at(sample_idx);
+                                output_["ElapsedTime"].at(sample_idx) = elapsed_stored + elapsed/1000;
+                        } else {
+                                output_["Samples"].push_back(sample);
+                                output_["ElapsedTime"].push_back(elapsed/1000);
+                        }
+                        std::ofstream out_file(filename_ + ".tmp");
                         out_file << output_ << std::endl;
+                        out_file.close();
+                        std::rename((filename_ + ".tmp").c_str(), filename_.c_str());
+                        if (!stored_file.empty() and stored_file != mps_file) {
+                                std::remove((dir + stored_file).c_str());
+                        }
                 }
 } // namespace randomMPS
 #endif //UUID_44723946_6E0D_4CAD_94D7_D0472947F58D
@@ -27,8 +27,10 @@
 #define UUID_DFB5FFA9_FC7D_4EE2_8096_AE8280CCE961
 #include <itensor/all_mps.h>
 #include <algorithm>
+#include <array>
 #include <complex>
 #include <cmath>
+#include <cstdint>
 #include <random>
 #include <stdexcept>
 #include <utility>
@@ -114,57 +116,51 @@ namespace RandomPhaseState {
                 return PossibleQNs;
         }
 
-        itensor::MPS RandomPhaseState(const itensor::SiteSet &sites, const itensor::QN &target, std::mt19937_64 &engine)
-        {
-                auto PossibleQNs = GeneratePossibleQNs(sites, target);
-                int N = itensor::length(sites);
-                itensor::MPS psi(sites);
-                std::vector<itensor::Index> links(N+1);
-                for (int l = 0; l <= N; l++)
-                {
-                        std::vector<std::pair<itensor::QN, long>> qnstorage;
-                        auto ts = itensor::format("Link,l=%d", l);
-                        for (auto&& qn : PossibleQNs[l])
-                        {
-                                qnstorage.emplace_back(qn, 1);
-                        }
-                        links[l] = itensor::Index(std::move(qnstorage), itensor::Out, ts);
-                }
+        /// @class Philox
+        /// @brief Counter-based random number generator Philox4x32-10
+        ///
+        /// Random numbers are determined only by the key (seed, sample index, stream) and the counter (site, element),
+        /// so that any sample can be regenerated independently of the other samples.
+        /// Different streams give independent random numbers for the same sample as long as sample indices are below 2^32.
+        class Philox {
+                private:
+                        std::array<uint32_t, 2> key_;
+                        uint64_t sample_;
+                        uint32_t stream_;
 
-                std::uniform_real_distribution<> dist(0.0, 4.0*std::acos(0.0));
+                public:
+                        /// @brief Constructor with the key of the generator
+                        ///
+                        /// @param seed random seed
+                        /// @param sample index of the sample to be generated
+                        /// @param stream index of the stream used for a purpose other than random phases
+                        Philox(uint64_t seed, uint64_t sample, uint32_t stream = 0)
+                                : key_{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)}, sample_(sample), stream_(stream) {}
+                        /// @brief Method to produce a uniform random number in [0, 1)
+                        ///
+                        /// @param site index of site
+                        /// @param element index of element in the local tensor on the site
+                        double operator()(uint32_t site, uint32_t element) const;
+        };
 
-                for (int n = 1; n <= N; n++)
-                {
-                        auto & A = psi.ref(n);
-                        auto row = itensor::dag(links.at(n-1));
-                        auto col = links.at(n);
-
-                        A = itensor::ITensor(sites(n), row, col);
-                        for (int d = 1; d <= itensor::dim(sites(n)); d++)
-                        {
-                                for (int l = 1; l <= itensor::dim(row); l++)
-                                {
-                                        for (int k = 1; k <= itensor::dim(col); k++)
-                                        {
-                                                if (row.qn(l) - sites(n).qn(d) == col.qn(k))
-                                                {
-                                                        double theta = dist(engine);
-                                                        A.set(sites(n)(d), row(l), col(k), std::complex<double>(std::cos(theta), std::sin(theta)));
-                                                }
-                                        }
-                                }
-                        }
+        double Philox::operator()(uint32_t site, uint32_t element) const {
+                std::array<uint32_t, 4> ctr{static_cast<uint32_t>(sample_), static_cast<uint32_t>(sample_ >> 32) ^ stream_, site, element};
+                auto key = key_;
+                for (int round = 0; round < 10; round++) {
+                        uint64_t prod0 = static_cast<uint64_t>(0xD2511F53u) * ctr[0];
+                        uint64_t prod1 = static_cast<uint64_t>(0xCD9E8D57u) * ctr[2];
+                        ctr = {static_cast<uint32_t>(prod1 >> 32) ^ ctr[1] ^ key[0], static_cast<uint32_t>(prod1),
+                               static_cast<uint32_t>(prod0 >> 32) ^ ctr[3] ^ key[1], static_cast<uint32_t>(prod0)};
+                        key[0] += 0x9E3779B9u;
+                        key[1] += 0xBB67AE85u;
                 }
-                psi.ref(1) *= itensor::setElt(links.at(0)(1));
-                psi.ref(N) *= itensor::setElt(itensor::dag(links.at(N)(1)));
-
-                psi.position(1);
-                psi.normalize();
-
-                return psi;
+                // 53 random bits for the mantissa of double
+                uint64_t bits = (static_cast<uint64_t>(ctr[0]) << 21) ^ (ctr[1] >> 11);
+                return static_cast<double>(bits) * 0x1.0p-53;
         }
 
-        itensor::MPS RandomPhaseState(const itensor::SiteSet &sites, const std::vector<std::vector<itensor::QN>> &PossibleQNs, std::mt19937_64 &engine)
+        template <typename PhaseFunc>
+        itensor::MPS PhaseState(const itensor::SiteSet &sites, const std::vector<std::vector<itensor::QN>> &PossibleQNs, PhaseFunc &&phase)
         {
                 int N = itensor::length(sites);
                 itensor::MPS psi(sites);
@@ -180,8 +176,6 @@ namespace RandomPhaseState {
                         links[l] = itensor::Index(std::move(qnstorage), itensor::Out, ts);
                 }
 
-                std::uniform_real_distribution<> dist(0.0, 4.0*std::acos(0.0));
-
                 for (int n = 1; n <= N; n++)
                 {
                         auto & A = psi.ref(n);
@@ -189,6 +183,7 @@ namespace RandomPhaseState {
                         auto col = links.at(n);
 
                         A = itensor::ITensor(sites(n), row, col);
+                        int element = 0;
                         for (int d = 1; d <= itensor::dim(sites(n)); d++)
                         {
                                 for (int l = 1; l <= itensor::dim(row); l++)
@@ -197,7 +192,7 @@ namespace RandomPhaseState {
                                         {
                                                 if (row.qn(l) - sites(n).qn(d) == col.qn(k))
                                                 {
-                                                        double theta = dist(engine);
+                                                        double theta = phase(n, element++);
                                                         A.set(sites(n)(d), row(l), col(k), std::complex<double>(std::cos(theta), std::sin(theta)));
                                                 }
                                         }
@@ -212,7 +207,8 @@ namespace RandomPhaseState {
                 return psi;
         }
 
-        itensor::MPS RandomPhaseState(const itensor::SiteSet &sites, std::mt19937_64 &engine)
+        template <typename PhaseFunc>
+        itensor::MPS PhaseState(const itensor::SiteSet &sites, PhaseFunc &&phase)
         {
                 int N = itensor::length(sites);
                 if (itensor::hasQNs(sites(1))) {
@@ -225,7 +221,6 @@ namespace RandomPhaseState {
                         links.at(l) = itensor::Index(1, ts);
                 }
 
-                std::uniform_real_distribution<> dist(0.0, 4.0*std::acos(0.0));
                 for (int n = 1; n <= N; n++) {
                         auto &A = psi.ref(n);
                         auto row = links.at(n-1);
@@ -233,7 +228,7 @@ namespace RandomPhaseState {
 
                         A = itensor::ITensor(sites(n), row, col);
                         for (int d = 1; d <= itensor::dim(sites(n)); d++) {
-                                double theta = dist(engine);
+                                double theta = phase(n, d-1);
                                 A.set(sites(n)(d), row(1), col(1), std::complex<double>(std::cos(theta), std::sin(theta)));
                         }
                 }
@@ -245,5 +240,43 @@ namespace RandomPhaseState {
 
                 return psi;
         }
+
+        itensor::MPS RandomPhaseState(const itensor::SiteSet &sites, const std::vector<std::vector<itensor::QN>> &PossibleQNs, std::mt19937_64 &engine)
+        {
+                std::uniform_real_distribution<> dist(0.0, 4.0*std::acos(0.0));
+                return PhaseState(sites, PossibleQNs, [&dist, &engine](int, int){ return dist(engine); });
+        }
+
+        itensor::MPS RandomPhaseState(const itensor::SiteSet &sites, const std::vector<std::vector<itensor::QN>> &PossibleQNs, const Philox &rng)
+        {
+                return PhaseState(sites, PossibleQNs, [&rng](int n, int element){ return 4.0*std::acos(0.0)*rng(n, element); });
+        }
+
+        itensor::MPS RandomPhaseState(const itensor::SiteSet &sites, const itensor::QN &target, std::mt19937_64 &engine)
+        {
+                auto psi = RandomPhaseState(sites, GeneratePossibleQNs(sites, target), engine);
+                psi.normalize();
+
+                return psi;
+        }
+
+        itensor::MPS RandomPhaseState(const itensor::SiteSet &sites, const itensor::QN &target, const Philox &rng)
+        {
+                auto psi = RandomPhaseState(sites, GeneratePossibleQNs(sites, target), rng);
+                psi.normalize();
+
+                return psi;
+        }
+
+        itensor::MPS RandomPhaseState(const itensor::SiteSet &sites, std::mt19937_64 &engine)
+        {
+                std::uniform_real_distribution<> dist(0.0, 4.0*std::acos(0.0));
+                return PhaseState(sites, [&dist, &engine](int, int){ return dist(engine); });
+        }
+
+        itensor::MPS RandomPhaseState(const itensor::SiteSet &sites, const Philox &rng)
+        {
+                return PhaseState(sites, [&rng](int n, int element){ return 4.0*std::acos(0.0)*rng(n, element); });
+        }
 } // namespace RandomPhaseState
 #endif //UUID_DFB5FFA9_FC7D_4EE2_8096_AE8280CCE961
@@ -0,0 +1,170 @@
+# Licensed under the MIT License <http://opensource.org/MIT>
+#
+# Copyright (c) 2021 Shimpei Goto
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+import numpy as np
+import toml
+import json
+from glob import glob
+
+
+def LoadData(storage):
+    energies = []
+    samples = glob('sample_*.json')
+    if not samples:
+        raise RuntimeError('No sample_*.json files in this directory')
+    for i, sample in enumerate(samples):
+        data = json.load(open(sample))
+        # METTS samples are not weighted by their norms like random phase states
+        if data.get('Method') == 'METTS':
+            raise RuntimeError('{} is produced by METTS. '
+                               'Use PlotJackknife.py instead'.format(sample))
+        if any('SzDistribution' not in each for each in data['Samples']):
+            raise RuntimeError('{} is produced without FieldReweighting = '
+                               'true in the section System'.format(sample))
+        if i == 0:
+            storage['beta'] = np.array(data['beta'])
+        energies.append(data['LowestEnergy'])
+
+    gene = min(energies)
+
+    norm_sq_arr = []
+    ene_arr = []
+    ene_sq_arr = []
+    for sample in samples:
+        data = json.load(open(sample))
+        for each in data['Samples']:
+            norm = (np.exp(0.5*storage['beta']*(gene - each['Energy'][-1]))
+                    * np.array(each['Norm']))
+            weight = (norm*norm)[:, np.newaxis]
+            norm_sq_arr.append(weight*np.array(each['SzDistribution']))
+            ene_arr.append(weight*np.array(each['EnergyBySz']))
+            ene_sq_arr.append(weight*np.array(each['SquaredEnergyBySz']))
+    storage['LowestEnergy'] = gene
+    storage['SquaredNorm'] = np.array(norm_sq_arr)
+    storage['Energy'] = np.array(ene_arr)
+    storage['SquaredEnergy'] = np.array(ene_sq_arr)
+    storage['Nsamples'] = len(norm_sq_arr)
+
+
+def Bootstrapped(storage):
+    nsample = storage['Nsamples']
+    select = np.random.randint(nsample, size=nsample)
+    return {key: np.average(storage[key][select], axis=0)
+            for key in ['SquaredNorm', 'Energy', 'SquaredEnergy']}
+
+
+storage = {}
+LoadData(storage)
+
+setting = toml.load(open('setting.toml'))
+L = setting['System']['Lattice']
+# Magnetic field used in the simulation, H(h) = H_0 + h*Sz
+h_ref = setting['System']['MagneticField']
+
+boot_setting = toml.load(open('bootstrap.toml'))
+h_low = boot_setting['Bootstrap']['MagneticField']['LowH']
+h_high = boot_setting['Bootstrap']['MagneticField']['HighH']
+h_num = boot_setting['Bootstrap']['MagneticField']['HNumber']
+h_list = np.linspace(h_low, h_high, h_num)
+
+nB = boot_setting['Bootstrap']['BootstrapNumber']
+
+beta = storage['beta']
+nBeta = beta.size
+sz = np.arange(L+1) - L/2
+
+result = {
+        'Beta': beta.tolist(), 'MagneticField': h_list.tolist(),
+        'SystemSize': L, 'BootstrapSize': nB,
+        'Energy': {'Average': [], 'Error': []},
+        'Magnetization': {'Average': [], 'Error': []},
+        'Susceptibility': {'Average': [], 'Error': []},
+        'SpecificHeat': {'Average': [], 'Error': []},
+        'SpecificHeatFromS': {'Average': [], 'Error': []},
+        'Entropy': {'Average': [], 'Error': []},
+        'NormalizedPartitionFunction': {'Average': [], 'Error': []}
+          }
+bootstrap_data = []
+for bootstrap in range(nB):
+    bootstrap_data.append(Bootstrapped(storage))
+
+for h in h_list:
+    # Magnetic field h in bootstrap.toml enters as H_0 - h*Sz as in BootstrapAnalysis.py
+    dh = -h - h_ref
+    lamb_min = storage['LowestEnergy'] + (dh*sz).min()
+    weight = np.exp(-np.outer(beta, dh*sz - (dh*sz).min()))
+
+    energy = np.empty([nBeta, nB])
+    entropy = np.empty([nBeta, nB])
+    magnetization = np.empty([nBeta, nB])
+    susceptibility = np.empty([nBeta, nB])
+    specificheat = np.empty([nBeta, nB])
+    specificheat_s = np.empty([nBeta, nB])
+    partition = np.empty([nBeta, nB])
+    for idx, data in enumerate(bootstrap_data):
+        norm_sq = data['SquaredNorm']
+        ene_ref = data['Energy']
+        ene_sq_ref = data['SquaredEnergy']
+        denom = np.sum(weight*norm_sq, axis=1)
+        # Energies of H_0 - h*Sz = H(h_ref) + dh*Sz in each Sz sector
+        numer_E = np.sum(weight*(ene_ref + dh*sz*norm_sq), axis=1)
+        numer_ESq = np.sum(weight*(ene_sq_ref + 2*dh*sz*ene_ref
+                                   + dh*dh*sz*sz*norm_sq), axis=1)
+        numer_M = np.sum(weight*sz*norm_sq, axis=1)
+        numer_MSq = np.sum(weight*sz*sz*norm_sq, axis=1)
+        ene = numer_E / denom
+        ene_sq = numer_ESq / denom
+        mag = numer_M / denom
+        mag_sq = numer_MSq / denom
+        energy[:, idx] = ene + h*mag
+        entropy[:, idx] = beta*(ene - lamb_min) + np.log(denom)
+        specificheat_s[0, idx] = -beta[0] * (
+                (entropy[1, idx] - entropy[0, idx])
+                / (beta[1] - beta[0])
+                )
+        specificheat_s[1:-1, idx] = -beta[1:-1]*np.array(
+                [(entropy[i+1, idx] - entropy[i-1, idx])
+                 / (beta[i+1] - beta[i-1])
+                 for i in range(1, nBeta-1)
+                 ]
+                )
+        specificheat_s[-1, idx] = -beta[-1] * (
+                (entropy[-1, idx] - entropy[-2, idx])
+                / (beta[-1] - beta[-2])
+                )
+        partition[:, idx] = denom
+        magnetization[:, idx] = mag
+        susceptibility[:, idx] = beta*(mag_sq - np.square(mag))
+        specificheat[:, idx] = np.square(beta)*(ene_sq - np.square(ene))
+
+    for key, arr in [('Energy', energy), ('Entropy', entropy),
+                     ('Magnetization', magnetization),
+                     ('Susceptibility', susceptibility),
+                     ('SpecificHeat', specificheat),
+                     ('SpecificHeatFromS', specificheat_s),
+                     ('NormalizedPartitionFunction', partition)]:
+        result[key]['Average'].append(np.average(arr, axis=1).tolist())
+        result[key]['Error'].append(np.sqrt(np.var(arr, axis=1)).tolist())
+    print(h)
+
+    with open('bootstrapped.json', 'w') as f:
+        json.dump(result, f)